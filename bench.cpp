@@ -0,0 +1,256 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "terrain.hpp"
+#include "heightfield.hpp"
+#include "noise.hpp"
+#include "rtin.hpp"
+#include "render_queue.hpp"
+
+#define BENCH_QUERY_COUNT (1 << 20)
+#define BENCH_REPEATS 20
+#define BENCH_NOISE_REPEATS 200
+#define BENCH_RTIN_GRID_SIZE (MESH_X_VERTICES_SIZE + 1)
+#define BENCH_RTIN_REPEATS 50
+#define BENCH_QUEUE_CHUNKS 4096
+#define BENCH_QUEUE_MATERIALS 16
+#define BENCH_QUEUE_REPEATS 100
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+//==============================================================================
+// HEIGHTFIELD QUERIES
+//==============================================================================
+
+//returns false when the batched path disagrees with height_at
+bool bench_heightfield()
+{
+    std::vector<float> noise(MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE);
+    std::srand(0);
+    for (size_t i = 0; i < noise.size(); i++)
+    {
+        noise[i] = (float) std::rand() / (float) RAND_MAX;
+    }
+    Heightfield heightfield(noise.data(), MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE,
+                            MESH_X_VERTICES_SIZE - 1, MESH_Z_VERTICES_SIZE - 1);
+
+    //queries slightly past the edges to exercise the clamping
+    std::vector<float> xs(BENCH_QUERY_COUNT), zs(BENCH_QUERY_COUNT);
+    for (int i = 0; i < BENCH_QUERY_COUNT; i++)
+    {
+        xs[i] = ((float) std::rand() / (float) RAND_MAX - 0.5f) * (MESH_X_VERTICES_SIZE + 8);
+        zs[i] = ((float) std::rand() / (float) RAND_MAX - 0.5f) * (MESH_Z_VERTICES_SIZE + 8);
+    }
+    //and a few non-finite ones, which both paths must clamp the same way
+    float oddValues[] = { NAN, INFINITY, -INFINITY, NAN, 0.0f, -INFINITY, NAN, INFINITY };
+    for (int i = 0; i < 8; i++)
+    {
+        xs[i] = oddValues[i];
+        zs[i] = oddValues[7 - i];
+    }
+
+    std::vector<float> scalar(BENCH_QUERY_COUNT), batched(BENCH_QUERY_COUNT);
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    {
+        for (int i = 0; i < BENCH_QUERY_COUNT; i++)
+        {
+            scalar[i] = heightfield.height_at(xs[i], zs[i]);
+        }
+    }
+    double scalar_seconds = seconds_since(start);
+
+    start = bench_clock::now();
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    {
+        heightfield.heights_at(xs.data(), zs.data(), batched.data(), BENCH_QUERY_COUNT);
+    }
+    double batched_seconds = seconds_since(start);
+
+    float max_error = 0.0f;
+    for (int i = 0; i < BENCH_QUERY_COUNT; i++)
+    {
+        //written so a NaN on either side shows up as the max diff
+        float error = std::fabs(scalar[i] - batched[i]);
+        if (!(error <= max_error))
+        {
+            max_error = error;
+        }
+    }
+
+    double queries = (double) BENCH_QUERY_COUNT * BENCH_REPEATS;
+    printf("heightfield height_at:  %8.2f Mqueries/s\n", queries / scalar_seconds / 1e6);
+    printf("heightfield heights_at: %8.2f Mqueries/s (max diff %g)\n", queries / batched_seconds / 1e6, max_error);
+    return max_error == 0.0f;
+}
+
+//==============================================================================
+// PERLIN NOISE KERNELS
+//==============================================================================
+
+//returns false when the specialized kernel disagrees with the generic path
+bool bench_perlin_noise(int octaveCount, float (*blend_func)(float), const char* blend_name)
+{
+    static float generic[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
+    static float specialized[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int r = 0; r < BENCH_NOISE_REPEATS; r++)
+    {
+        std::fill(std::begin(generic), std::end(generic), 0.0f);
+        generate_perlin_noise(generic, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, octaveCount, 0.5f, blend_func);
+    }
+    double generic_seconds = seconds_since(start);
+
+    start = bench_clock::now();
+    for (int r = 0; r < BENCH_NOISE_REPEATS; r++)
+    {
+        generate_perlin_noise_specialized(specialized, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, octaveCount, 0.5f, blend_func);
+    }
+    double specialized_seconds = seconds_since(start);
+
+    float max_error = 0.0f;
+    for (int i = 0; i < MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE; i++)
+    {
+        float error = std::fabs(generic[i] - specialized[i]);
+        if (!(error <= max_error))
+        {
+            max_error = error;
+        }
+    }
+
+    printf("perlin noise %d octaves %-7s generic %7.3f ms  specialized %7.3f ms (max diff %g)\n",
+           octaveCount, blend_name,
+           generic_seconds * 1e3 / BENCH_NOISE_REPEATS,
+           specialized_seconds * 1e3 / BENCH_NOISE_REPEATS,
+           max_error);
+    return max_error == 0.0f;
+}
+
+//==============================================================================
+// RTIN TRIANGULATION
+//==============================================================================
+
+void bench_rtin()
+{
+    static float noise[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
+    generate_perlin_noise_specialized(noise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, 5);
+    Heightfield heightfield(noise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE,
+                            MESH_X_VERTICES_SIZE - 1, MESH_Z_VERTICES_SIZE - 1);
+
+    std::vector<float> heights(BENCH_RTIN_GRID_SIZE * BENCH_RTIN_GRID_SIZE);
+    heightfield.grid_heights(BENCH_RTIN_GRID_SIZE, MESH_X_VERTICES_SIZE - 1, MESH_Z_VERTICES_SIZE - 1, heights.data());
+
+    Rtin rtin(BENCH_RTIN_GRID_SIZE);
+    bench_clock::time_point start = bench_clock::now();
+    for (int r = 0; r < BENCH_RTIN_REPEATS; r++)
+    {
+        rtin.update(heights.data());
+    }
+    printf("rtin error update: %.3f ms\n", seconds_since(start) * 1e3 / BENCH_RTIN_REPEATS);
+
+    Rtin::Buffer vertices, triangles;
+    float maxErrors[] = { -1.0f, 0.0f, 0.01f, 0.05f, 0.1f, 0.25f, 0.5f, 1.0f, 2.0f };
+    for (float maxError : maxErrors)
+    {
+        start = bench_clock::now();
+        int triangleCount = 0;
+        for (int r = 0; r < BENCH_RTIN_REPEATS; r++)
+        {
+            triangleCount = rtin.mesh(maxError, vertices, triangles);
+        }
+        double mesh_seconds = seconds_since(start) / BENCH_RTIN_REPEATS;
+
+        printf("rtin error %5.2f: %6d triangles (%5.1f%% of grid) %6d vertices, mesh %.3f ms\n",
+               maxError, triangleCount, 100.0 * triangleCount / MESH_TRIANGLES_COUNT,
+               (int)(vertices.size() / 2), mesh_seconds * 1e3);
+    }
+}
+
+//==============================================================================
+// RENDER QUEUE BATCHING
+//==============================================================================
+
+//chunks over ranges of one shared index buffer, each drawn with one of a few
+//materials in an interleaved order. Needs no GL context, only the queue's
+//sort and batching. Returns false unless every material becomes one draw.
+bool bench_render_queue()
+{
+    RenderQueue::PacketBuffer chunks;
+    for (int c = 0; c < BENCH_QUEUE_CHUNKS; c++)
+    {
+        int material = (c * 7) % BENCH_QUEUE_MATERIALS;
+        DrawPacket packet;
+        packet.program = 1 + (material & 1);
+        packet.textureUnit = GL_TEXTURE0 + ((material >> 1) & 1);
+        packet.texture = 1 + ((material >> 2) & 1);
+        packet.objectUniform = (material >> 3) & 1;
+        packet.vao = 1;
+        packet.count = 6 * 64;
+        packet.first = c * packet.count;
+        chunks.push_back(packet);
+    }
+
+    RenderQueue::PacketBuffer packets;
+    int draws = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (int r = 0; r < BENCH_QUEUE_REPEATS; r++)
+    {
+        packets = chunks;
+        RenderQueue::sort(packets);
+        draws = 0;
+        for (size_t i = 0; i < packets.size(); i = RenderQueue::batch_end(packets, i))
+        {
+            draws++;
+        }
+    }
+    double seconds = seconds_since(start) / BENCH_QUEUE_REPEATS;
+
+    printf("render queue: %d chunk packets -> %d draws (%d materials), sort and batch %.3f ms\n",
+           BENCH_QUEUE_CHUNKS, draws, BENCH_QUEUE_MATERIALS, seconds * 1e3);
+    return draws == BENCH_QUEUE_MATERIALS;
+}
+
+//==============================================================================
+// MAIN
+//==============================================================================
+
+//exits with a failure status when a fast path stops matching its reference
+//or the render queue stops batching
+int main()
+{
+    bool matching = bench_heightfield();
+
+    int octaveCounts[] = { 1, 5, 8 };
+    for (int octaveCount : octaveCounts)
+    {
+        matching &= bench_perlin_noise(octaveCount, blend, "quintic");
+        matching &= bench_perlin_noise(octaveCount, blend_cubic, "cubic");
+        matching &= bench_perlin_noise(octaveCount, blend_linear, "linear");
+    }
+
+    bench_rtin();
+    matching &= bench_render_queue();
+
+    printf("\n");
+    memory_tracker().report(stdout);
+
+    if (!matching)
+    {
+        fprintf(stderr, "bench: a check failed, see the output above\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef HEIGHTFIELD_HPP
+#define HEIGHTFIELD_HPP
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+#include "terrain.hpp"
+#include "memory_tracker.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEIGHTFIELD_AVX2 1
+#include <immintrin.h>
+#endif
+
+//CPU side copy of the heightmap texture. Samples the noise the same way
+//scene.vert does (bilinear, clamp to edge, water clamp) so the ground height
+//can be queried without reading back from the GPU. The data never changes
+//after construction, so queries are safe from any number of threads.
+class Heightfield
+{
+public:
+    typedef std::vector<float, TrackedAllocator<float, MEMORY_HEIGHTFIELD> > FloatBuffer;
+
+    //noise is width * height texels laid out like the heightmap texture
+    //(row t, column s). The mesh spans x_extent by z_extent world units
+    //centered on the origin.
+    Heightfield(const float* noise, int width, int height, float x_extent, float z_extent)
+        : _texels(noise, noise + width * height)
+    {
+        _width = width;
+        _height = height;
+
+        //world -> texel space, texel centers sit at +0.5
+        _s_scale = width / x_extent;
+        _t_scale = height / z_extent;
+        _s_offset = 0.5f * width - 0.5f;
+        _t_offset = 0.5f * height - 0.5f;
+
+#ifdef HEIGHTFIELD_AVX2
+        _use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    };
+
+    int width() const
+    {
+        return _width;
+    };
+
+    int height() const
+    {
+        return _height;
+    };
+
+    //ground height at world (x, z). Coordinates off the map, including
+    //infinities and NaN, read the nearest edge like the AVX2 path.
+    float height_at(float x, float z) const
+    {
+        float s = clamp_texel(x * _s_scale + _s_offset, (float)(_width - 1));
+        float t = clamp_texel(z * _t_scale + _t_offset, (float)(_height - 1));
+
+        int s0 = (int)s;
+        int t0 = (int)t;
+        int s1 = std::min(s0 + 1, _width - 1);
+        int t1 = std::min(t0 + 1, _height - 1);
+        float fs = s - s0;
+        float ft = t - t0;
+
+        float top = _texels[t0 * _width + s0] * (1.0f - fs) + _texels[t0 * _width + s1] * fs;
+        float bottom = _texels[t1 * _width + s0] * (1.0f - fs) + _texels[t1 * _width + s1] * fs;
+        float value = top * (1.0f - ft) + bottom * ft;
+
+        return std::max(value, TERRAIN_WATER_LEVEL) * TERRAIN_HEIGHT_SCALE;
+    };
+
+    //batched version of height_at, heights[i] = height_at(xs[i], zs[i])
+    void heights_at(const float* xs, const float* zs, float* heights, size_t count) const
+    {
+        size_t i = 0;
+#ifdef HEIGHTFIELD_AVX2
+        if (_use_avx2)
+        {
+            i = heights_at_avx2(xs, zs, heights, count);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            heights[i] = height_at(xs[i], zs[i]);
+        }
+    };
+
+    //heights of a grid_size * grid_size lattice evenly spanning the same
+    //x_extent by z_extent area, row by row along z
+    void grid_heights(int grid_size, float x_extent, float z_extent, float* heights) const
+    {
+        FloatBuffer xs(grid_size), zs(grid_size);
+        for (int row = 0; row < grid_size; row++)
+        {
+            for (int column = 0; column < grid_size; column++)
+            {
+                xs[column] = column * x_extent / (grid_size - 1) - x_extent / 2.0f;
+                zs[column] = row * z_extent / (grid_size - 1) - z_extent / 2.0f;
+            }
+            heights_at(xs.data(), zs.data(), heights + row * grid_size, grid_size);
+        }
+    };
+
+private:
+
+    //same operand order as _mm256_max_ps / _mm256_min_ps, so NaN becomes 0
+    //instead of reaching the (int) conversion
+    static float clamp_texel(float value, float max)
+    {
+        value = value > 0.0f ? value : 0.0f;
+        return value < max ? value : max;
+    };
+
+#ifdef HEIGHTFIELD_AVX2
+    //8 queries at a time, returns how many were answered
+    __attribute__((target("avx2")))
+    size_t heights_at_avx2(const float* xs, const float* zs, float* heights, size_t count) const
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 s_scale = _mm256_set1_ps(_s_scale);
+        const __m256 t_scale = _mm256_set1_ps(_t_scale);
+        const __m256 s_offset = _mm256_set1_ps(_s_offset);
+        const __m256 t_offset = _mm256_set1_ps(_t_offset);
+        const __m256 s_max = _mm256_set1_ps((float)(_width - 1));
+        const __m256 t_max = _mm256_set1_ps((float)(_height - 1));
+        const __m256i s_last = _mm256_set1_epi32(_width - 1);
+        const __m256i t_last = _mm256_set1_epi32(_height - 1);
+        const __m256i row = _mm256_set1_epi32(_width);
+        const __m256i step = _mm256_set1_epi32(1);
+        const __m256 water = _mm256_set1_ps(TERRAIN_WATER_LEVEL);
+        const __m256 scale = _mm256_set1_ps(TERRAIN_HEIGHT_SCALE);
+        const float* texels = _texels.data();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(xs + i), s_scale), s_offset);
+            __m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(zs + i), t_scale), t_offset);
+            s = _mm256_min_ps(_mm256_max_ps(s, zero), s_max);
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), t_max);
+
+            __m256i s0 = _mm256_cvttps_epi32(s);
+            __m256i t0 = _mm256_cvttps_epi32(t);
+            __m256i s1 = _mm256_min_epi32(_mm256_add_epi32(s0, step), s_last);
+            __m256i t1 = _mm256_min_epi32(_mm256_add_epi32(t0, step), t_last);
+            __m256 fs = _mm256_sub_ps(s, _mm256_cvtepi32_ps(s0));
+            __m256 ft = _mm256_sub_ps(t, _mm256_cvtepi32_ps(t0));
+
+            __m256i row0 = _mm256_mullo_epi32(t0, row);
+            __m256i row1 = _mm256_mullo_epi32(t1, row);
+            __m256 t00 = _mm256_i32gather_ps(texels, _mm256_add_epi32(row0, s0), 4);
+            __m256 t10 = _mm256_i32gather_ps(texels, _mm256_add_epi32(row0, s1), 4);
+            __m256 t01 = _mm256_i32gather_ps(texels, _mm256_add_epi32(row1, s0), 4);
+            __m256 t11 = _mm256_i32gather_ps(texels, _mm256_add_epi32(row1, s1), 4);
+
+            __m256 fs_inv = _mm256_sub_ps(one, fs);
+            __m256 ft_inv = _mm256_sub_ps(one, ft);
+            __m256 top = _mm256_add_ps(_mm256_mul_ps(t00, fs_inv), _mm256_mul_ps(t10, fs));
+            __m256 bottom = _mm256_add_ps(_mm256_mul_ps(t01, fs_inv), _mm256_mul_ps(t11, fs));
+            __m256 value = _mm256_add_ps(_mm256_mul_ps(top, ft_inv), _mm256_mul_ps(bottom, ft));
+
+            _mm256_storeu_ps(heights + i, _mm256_mul_ps(_mm256_max_ps(value, water), scale));
+        }
+        return i;
+    };
+#endif
+
+    FloatBuffer _texels;
+    int _width;
+    int _height;
+
+    float _s_scale;
+    float _t_scale;
+    float _s_offset;
+    float _t_offset;
+
+    bool _use_avx2 = false;
+};
+
+#endif
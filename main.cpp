@@ -11,27 +11,42 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <SOIL/SOIL.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <fstream>
 #include <vector>
 #include <chrono>
 #include <algorithm>
 #include "camera.hpp"
-
-#define MESH_X_VERTICES_SIZE 128
-#define MESH_Z_VERTICES_SIZE 128
+#include "terrain.hpp"
+#include "heightfield.hpp"
+#include "noise.hpp"
+#include "rtin.hpp"
+#include "render_queue.hpp"
+#include "memory_tracker.hpp"
 
 //(MESH_X_SIZE + 1) * MESH_Z_SIZE * (NUM_POINTS_PER_VERTEX + NUM_COLOR_POINTS + NUM_UV)
 #define MESH_VERTICES_COUNT (MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE * (3 + 3 + 2 + 2))
 
 #define MESH_INDICES_COUNT (((MESH_X_VERTICES_SIZE + MESH_Z_VERTICES_SIZE - 1) * MESH_Z_VERTICES_SIZE) - 1)
 
+//rtin needs (2^k + 1) samples a side
+#define RTIN_GRID_SIZE (MESH_X_VERTICES_SIZE + 1)
+#define RTIN_DEFAULT_MAX_ERROR 0.25f
+#define RTIN_MIN_MAX_ERROR (1.0f / 64.0f)
+#define RTIN_MAX_MAX_ERROR 2.0f
+
+typedef std::vector<GLfloat, TrackedAllocator<GLfloat, MEMORY_RTIN> > RtinFloatBuffer;
+
 #define SHADER_POSITION "vertexPosition"
 #define SHADER_COLOR    "vertexColor"
 #define SHADER_TEXCOORD "vertexTexcoord"
 #define SHADER_HEIGHTMAP "vertexHeightmap"
 #define SHADER_CURRENT_OBJECT "vertexCurrentObject"
 
+//how far the camera is kept above the ground
+#define CAMERA_GROUND_CLEARANCE 1.0f
+
 
 //==============================================================================
 // SHADER LOADER
@@ -135,7 +150,7 @@ GLFWwindow* initializeWindow()
 // UPDATE FPS TRACKER
 //==============================================================================
 
-void update_fps (GLFWwindow* window) {
+void update_fps (GLFWwindow* window, const char* stats) {
     static double previous_seconds = glfwGetTime ();
     static int frame_count;
     double current_seconds = glfwGetTime ();
@@ -144,14 +159,85 @@ void update_fps (GLFWwindow* window) {
     if (elapsed_seconds > 0.25) {
         previous_seconds = current_seconds;
         double fps = (double)frame_count / elapsed_seconds;
-        char tmp[128];
-        sprintf (tmp, "BBlashko --- RealTimeRendering @ fps: %.2f", fps);
+        char tmp[256];
+        snprintf (tmp, sizeof(tmp), "BBlashko --- RealTimeRendering @ fps: %.2f (%.2f ms) %s", fps, 1000.0 / fps, stats);
         glfwSetWindowTitle (window, tmp);
         frame_count = 0;
     }
     frame_count++;
 }
 
+//==============================================================================
+// TRACKED RESOURCES
+//==============================================================================
+
+//SOIL image, charged to the textures until free_image
+unsigned char* load_image(const char* filename, int* width, int* height)
+{
+    unsigned char* image = SOIL_load_image(filename, width, height, 0, SOIL_LOAD_RGBA);
+    if (image)
+    {
+        memory_tracker().allocate(MEMORY_TEXTURES, MEMORY_HOST, (size_t) *width * *height * 4);
+    }
+    return image;
+}
+
+void free_image(unsigned char* image, int width, int height)
+{
+    if (image)
+    {
+        memory_tracker().release(MEMORY_TEXTURES, MEMORY_HOST, (size_t) width * height * 4);
+    }
+    SOIL_free_image_data(image);
+}
+
+//glBufferData on the buffer bound to target, charging its size to category
+void tracked_buffer_data(MemoryCategory category, GLenum target, GLuint buffer, GLsizeiptr size,
+                         const void* data, GLenum usage)
+{
+    glBufferData(target, size, data, usage);
+    memory_tracker().track_gl_object(MEMORY_GL_BUFFER, buffer, category, size);
+}
+
+void delete_tracked_buffers(GLsizei n, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < n; i++)
+    {
+        memory_tracker().untrack_gl_object(MEMORY_GL_BUFFER, buffers[i]);
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+//texture storage with its full mip chain, faces is 6 for cube maps
+void track_texture(GLuint texture, int width, int height, int bytesPerTexel, int faces)
+{
+    memory_tracker().track_gl_object(MEMORY_GL_TEXTURE, texture, MEMORY_TEXTURES,
+                                     faces * memory_texture_bytes(width, height, bytesPerTexel, true));
+}
+
+void delete_tracked_textures(GLsizei n, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < n; i++)
+    {
+        memory_tracker().untrack_gl_object(MEMORY_GL_TEXTURE, textures[i]);
+    }
+    glDeleteTextures(n, textures);
+}
+
+//==============================================================================
+// KEY PRESSES
+//==============================================================================
+
+//true only on the frame a key goes down, not while it is held
+bool key_pressed_once(GLFWwindow* window, int key)
+{
+    static bool wasPressed[GLFW_KEY_LAST + 1];
+    bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+    bool once = pressed && !wasPressed[key];
+    wasPressed[key] = pressed;
+    return once;
+}
+
 //==============================================================================
 // TERRAIN MESH
 //==============================================================================
@@ -164,7 +250,7 @@ void generate_mesh_vertex_buffer(GLfloat (&vertexBuffer)[MESH_VERTICES_COUNT])
     float u_translate = abs(x);
     float v_translate = abs(z_init);
 
-    for (int i = 0; i < MESH_VERTICES_COUNT; i)
+    for (int i = 0; i < MESH_VERTICES_COUNT;)
     {
         for (int j = z_init; j < MESH_Z_VERTICES_SIZE / 2.0f; j++)
         {
@@ -193,7 +279,8 @@ void generate_mesh_vertex_buffer(GLfloat (&vertexBuffer)[MESH_VERTICES_COUNT])
 void generate_mesh_index_buffer(GLint (&indexBuffer)[MESH_INDICES_COUNT])
 {
     int i = 0;
-    for (int x = 0; x < MESH_X_VERTICES_SIZE; x++)
+    //the last column has no column after it to make a strip with
+    for (int x = 0; x < MESH_X_VERTICES_SIZE - 1; x++)
     {
         for (int z = 0; z < MESH_Z_VERTICES_SIZE;  z++)
         {
@@ -204,107 +291,60 @@ void generate_mesh_index_buffer(GLint (&indexBuffer)[MESH_INDICES_COUNT])
     }
 }
 
-//==============================================================================
-// PERLIN NOISE
-//==============================================================================
-
-float rand_func()
+//rtin triangulation of the heightmap, vertices use the same layout as
+//generate_mesh_vertex_buffer and indices are plain triangles
+void generate_rtin_mesh_buffers(Rtin& rtin, float maxError, RtinFloatBuffer& vertexBuffer,
+                                Rtin::Buffer& indexBuffer)
 {
-    return ((float) std::rand())/((float) RAND_MAX);
-}
-
-float interpolate(float x, float y, float alpha)
-{
-    return (x * (1.0f - alpha)) + (alpha * y);
-}
+    Rtin::Buffer gridVertices;
+    rtin.mesh(maxError, gridVertices, indexBuffer);
 
-float blend(float t)
-{
-    float t3 = t * t * t;
-    return 6 * t * t * t3 - 15 * t * t3 + 10 * t3;
-}
+    float spacing = (MESH_X_VERTICES_SIZE - 1) / (float) (rtin.grid_size() - 1);
 
-void generate_base_noise(GLfloat (&baseNoise)[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE], int width, int height)
-{
-    //random seed
-    std::srand(0);
-    for (int i = 0; i < width; i++)
+    vertexBuffer.clear();
+    for (size_t v = 0; v < gridVertices.size(); v += 2)
     {
-        for (int j = 0; j < height; j++)
-        {
-            baseNoise[i][j] = rand_func();
-        }
+        float u_translate = gridVertices[v] * spacing;
+        float v_translate = gridVertices[v + 1] * spacing;
+
+        //position
+        vertexBuffer.push_back(u_translate - (MESH_X_VERTICES_SIZE - 1) / 2.0f);
+        vertexBuffer.push_back(0.0f);
+        vertexBuffer.push_back(v_translate - (MESH_Z_VERTICES_SIZE - 1) / 2.0f);
+
+        //color
+        vertexBuffer.push_back(1.0f);
+        vertexBuffer.push_back(1.0f);
+        vertexBuffer.push_back(1.0f);
+
+        //uv
+        vertexBuffer.push_back(u_translate / (float) ((MESH_X_VERTICES_SIZE - 1) / (MESH_X_VERTICES_SIZE / 8)));
+        vertexBuffer.push_back(v_translate / (float) ((MESH_Z_VERTICES_SIZE - 1) / (MESH_Z_VERTICES_SIZE / 8)));
+
+        //uv for heightmap
+        vertexBuffer.push_back(u_translate / (float) (MESH_X_VERTICES_SIZE - 1));
+        vertexBuffer.push_back(v_translate / (float) (MESH_Z_VERTICES_SIZE - 1));
     }
 }
 
-void generate_smooth_noise(GLfloat (&baseNoise)[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE], int width, int height, int octave,
-                               GLfloat (&smoothNoise)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE])
+//rebuilds the rtin buffers for a new error threshold, returns the index count
+int upload_rtin_mesh(Rtin& rtin, float maxError, GLuint vao, GLuint vbo_vertices, GLuint vbo_indices)
 {
-    int period = pow(2, octave);
-    float frequency = 1.0f / period;
-    int n = 0;
-    for (int i = 0; i < width; i++)
-    {
-        int leftSample = (i / period) * period;
-        int rightSample = (leftSample + period) % width;
-        float dx_blend = (i - leftSample) * frequency;
-
-        for (int j = 0; j < height; j++)
-        {
-            int topSample = (j / period) * period;
-            int bottomSample = (topSample + period) % height;
-            float dy_blend = (j - topSample) * frequency;
-
-
-            float fx = blend(dx_blend);
-            float fy = blend(dy_blend);
-
-            float top = interpolate(baseNoise[leftSample][topSample],
-                                    baseNoise[rightSample][topSample],
-                                    fx);
-
-            float bottom = interpolate(baseNoise[leftSample][bottomSample],
-                                    baseNoise[rightSample][bottomSample],
-                                    fx);
-
-
-            smoothNoise[n++] = interpolate(top, bottom, fy);
-        }
-    }
-}
-
-void generate_perlin_noise(GLfloat (&perlinNoise)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE], int width, int height, int octaveCount)
-{
-    GLfloat baseNoise[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE];
-    generate_base_noise(baseNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE);
-
-    GLfloat smoothNoise[octaveCount][MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
-
-    float persistance = 0.5f;
-    float amplitude = 1.0f;
-    float totalAmplitude = 0.0f;
-
-    for (int i = 0; i < octaveCount; i++)
-    {
-        generate_smooth_noise(baseNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, i, smoothNoise[i]);
-    }
-
-    for (int octave = octaveCount - 1; octave >= 0; octave--)
-    {
-        amplitude *= persistance;
-        totalAmplitude += amplitude;
-
-        for (int i = 0; i < width * height; i++)
-        {
-            perlinNoise[i] += smoothNoise[octave][i] * amplitude;
-        }
-    }
-
-    for (int i = 0; i < width * height; i++)
-    {
-        perlinNoise[i] /= totalAmplitude;
-
-    }
+    RtinFloatBuffer vertexBuffer;
+    Rtin::Buffer indexBuffer;
+    generate_rtin_mesh_buffers(rtin, maxError, vertexBuffer, indexBuffer);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
+    tracked_buffer_data(MEMORY_RTIN, GL_ARRAY_BUFFER, vbo_vertices, vertexBuffer.size() * sizeof(GLfloat),
+                        vertexBuffer.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_indices);
+    tracked_buffer_data(MEMORY_RTIN, GL_ELEMENT_ARRAY_BUFFER, vbo_indices, indexBuffer.size() * sizeof(GLuint),
+                        indexBuffer.data(), GL_STATIC_DRAW);
+
+    printf("rtin max error %.3f: %d triangles (%.1f%% of grid)\n", maxError, (int) (indexBuffer.size() / 3),
+           100.0f * (indexBuffer.size() / 3) / MESH_TRIANGLES_COUNT);
+    return indexBuffer.size();
 }
 
 //===========================================================================================
@@ -372,7 +412,9 @@ void generate_skybox_vertices(GLfloat (&skyboxVertices)[36 * 5])
 // MAIN
 //==============================================================================
 
-int main()
+//runs until the window closes. Everything allocated here, including the
+//stack arrays charged with MemoryScope, is released by the time it returns.
+void run_scene()
 {
     GLFWwindow* window = initializeWindow();
     //initialize drawing
@@ -405,8 +447,13 @@ int main()
 
     //generate perlin noise ****************************************************
     GLfloat perlinNoise[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
+    MemoryScope perlinNoiseMemory(MEMORY_NOISE, sizeof(perlinNoise));
     memset(perlinNoise, 0, sizeof(perlinNoise));
-    generate_perlin_noise(perlinNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, 5);
+    generate_perlin_noise_specialized(perlinNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, 5);
+
+    //cpu side ground heights, same sampling as scene.vert
+    Heightfield heightfield(perlinNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE,
+                            MESH_X_VERTICES_SIZE - 1, MESH_Z_VERTICES_SIZE - 1);
 
     //instantiate all textures *************************************************
     GLuint textureIDs[7];
@@ -431,6 +478,7 @@ int main()
 	glBindTexture(GL_TEXTURE_2D, textureIDs[0]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, 0, GL_RED, GL_FLOAT, perlinNoise);
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_texture(textureIDs[0], MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, 1, 1);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -442,10 +490,11 @@ int main()
     //water texture ************************************************************
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, textureIDs[1]);
-    unsigned char* image = SOIL_load_image("Textures/water.jpg", &width, &height, 0, SOIL_LOAD_RGBA);
+    unsigned char* image = load_image("Textures/water.jpg", &width, &height);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
+    track_texture(textureIDs[1], width, height, 4, 1);
+    free_image(image, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -455,9 +504,11 @@ int main()
     //sand texture *************************************************************
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, textureIDs[2]);
-    image = SOIL_load_image("Textures/sand.jpg", &width, &height, 0, SOIL_LOAD_RGBA);
+    image = load_image("Textures/sand.jpg", &width, &height);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_texture(textureIDs[2], width, height, 4, 1);
+    free_image(image, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -467,9 +518,11 @@ int main()
     //grass texture ************************************************************
     glActiveTexture(GL_TEXTURE3);
     glBindTexture(GL_TEXTURE_2D, textureIDs[3]);
-    image = SOIL_load_image("Textures/grass.jpg", &width, &height, 0, SOIL_LOAD_RGBA);
+    image = load_image("Textures/grass.jpg", &width, &height);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_texture(textureIDs[3], width, height, 4, 1);
+    free_image(image, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -479,9 +532,11 @@ int main()
     //mountain texture *********************************************************
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_2D, textureIDs[4]);
-    image = SOIL_load_image("Textures/mountain.jpg", &width, &height, 0, SOIL_LOAD_RGBA);
+    image = load_image("Textures/mountain.jpg", &width, &height);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_texture(textureIDs[4], width, height, 4, 1);
+    free_image(image, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -491,10 +546,11 @@ int main()
     //snow texture
     glActiveTexture(GL_TEXTURE5);
     glBindTexture(GL_TEXTURE_2D, textureIDs[5]);
-    image = SOIL_load_image("Textures/snow.jpg", &width, &height, 0, SOIL_LOAD_RGBA);
+    image = load_image("Textures/snow.jpg", &width, &height);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
+    track_texture(textureIDs[5], width, height, 4, 1);
+    free_image(image, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -514,11 +570,12 @@ int main()
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureIDs[6]);
     for(GLuint i = 0; i < faces.size(); i++)
     {
-        image = SOIL_load_image(faces[i], &width, &height, 0, SOIL_LOAD_RGBA);
+        image = load_image(faces[i], &width, &height);
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        free_image(image, width, height);
     }
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-    SOIL_free_image_data(image);
+    track_texture(textureIDs[6], width, height, 4, 6);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -534,13 +591,14 @@ int main()
 
     //set vertices vbo *********************************************************
     GLfloat vertexBuffer[MESH_VERTICES_COUNT];
+    MemoryScope vertexBufferMemory(MEMORY_TERRAIN_MESH, sizeof(vertexBuffer));
     generate_mesh_vertex_buffer(vertexBuffer);
 
     GLuint vbo_terrain_mesh_vertices;
     glGenBuffers(1, &vbo_terrain_mesh_vertices);
     glBindBuffer(GL_ARRAY_BUFFER, vbo_terrain_mesh_vertices);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexBuffer), vertexBuffer,
-                 GL_STATIC_DRAW);
+    tracked_buffer_data(MEMORY_TERRAIN_MESH, GL_ARRAY_BUFFER, vbo_terrain_mesh_vertices,
+                        sizeof(vertexBuffer), vertexBuffer, GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(positionAttrib);
     glVertexAttribPointer(positionAttrib, 3, GL_FLOAT, GL_FALSE,
@@ -560,19 +618,60 @@ int main()
 
     //set indices vbo***********************************************************
     GLint indexBuffer[MESH_INDICES_COUNT];
+    MemoryScope indexBufferMemory(MEMORY_TERRAIN_MESH, sizeof(indexBuffer));
     generate_mesh_index_buffer(indexBuffer);
 
     GLuint vbo_terrain_mesh_indicies;
     glGenBuffers(1, &vbo_terrain_mesh_indicies);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_terrain_mesh_indicies);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexBuffer), indexBuffer,
-               GL_STATIC_DRAW);
+    tracked_buffer_data(MEMORY_TERRAIN_MESH, GL_ELEMENT_ARRAY_BUFFER, vbo_terrain_mesh_indicies,
+                        sizeof(indexBuffer), indexBuffer, GL_STATIC_DRAW);
 
     glEnable(GL_PRIMITIVE_RESTART);
     glPrimitiveRestartIndex(-1);
 
+    //generate rtin terrain mesh ***********************************************
+    RtinFloatBuffer rtinHeights(RTIN_GRID_SIZE * RTIN_GRID_SIZE);
+    heightfield.grid_heights(RTIN_GRID_SIZE, MESH_X_VERTICES_SIZE - 1, MESH_Z_VERTICES_SIZE - 1, rtinHeights.data());
+    Rtin rtin(RTIN_GRID_SIZE);
+    rtin.update(rtinHeights.data());
+
+    GLuint vao_rtin_mesh;
+    glGenVertexArrays(1, &vao_rtin_mesh);
+    glBindVertexArray(vao_rtin_mesh);
+
+    GLuint vbo_rtin_mesh_vertices;
+    glGenBuffers(1, &vbo_rtin_mesh_vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_rtin_mesh_vertices);
+
+    glEnableVertexAttribArray(positionAttrib);
+    glVertexAttribPointer(positionAttrib, 3, GL_FLOAT, GL_FALSE,
+                          10 * sizeof(GLfloat), 0);
+
+    glEnableVertexAttribArray(colorAttrib);
+    glVertexAttribPointer(colorAttrib, 3, GL_FLOAT, GL_FALSE,
+                          10 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+    glEnableVertexAttribArray(texcoordAttrib);
+    glVertexAttribPointer(texcoordAttrib, 2, GL_FLOAT, GL_FALSE,
+                        10 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+
+    glEnableVertexAttribArray(heightmapAttrib);
+    glVertexAttribPointer(heightmapAttrib, 2, GL_FLOAT, GL_FALSE,
+                        10 * sizeof(GLfloat), (void*)(8 * sizeof(GLfloat)));
+
+    GLuint vbo_rtin_mesh_indices;
+    glGenBuffers(1, &vbo_rtin_mesh_indices);
+
+    //M toggles the rtin mesh, [ and ] halve and double its error threshold
+    bool useRtin = false;
+    float rtinMaxError = RTIN_DEFAULT_MAX_ERROR;
+    int rtinIndexCount = upload_rtin_mesh(rtin, rtinMaxError, vao_rtin_mesh,
+                                          vbo_rtin_mesh_vertices, vbo_rtin_mesh_indices);
+
     //generate skybox **********************************************************
     GLfloat skyboxVertices[36 * (3 + 2)];
+    MemoryScope skyboxVerticesMemory(MEMORY_SKYBOX, sizeof(skyboxVertices));
     memset(skyboxVertices, 0, sizeof(skyboxVertices));
     generate_skybox_vertices(skyboxVertices);
 
@@ -583,8 +682,8 @@ int main()
     GLuint vbo_skybox;
     glGenBuffers(1, &vbo_skybox);
     glBindBuffer(GL_ARRAY_BUFFER, vbo_skybox);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices,
-                 GL_STATIC_DRAW);
+    tracked_buffer_data(MEMORY_SKYBOX, GL_ARRAY_BUFFER, vbo_skybox,
+                        sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(positionAttrib);
     glVertexAttribPointer(positionAttrib, 3, GL_FLOAT, GL_FALSE,
@@ -596,17 +695,57 @@ int main()
 
     //update, render loop ****************************************************************
 
+    RenderQueue renderQueue;
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
     while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS
            && glfwWindowShouldClose(window) == 0)
     {
         //clear the color and draw the background color.
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        //update the fps in the window
-        update_fps(window);
+        if (key_pressed_once(window, GLFW_KEY_P))
+        {
+            memory_tracker().report(stdout);
+        }
+
+        //switch terrain mesh
+        if (key_pressed_once(window, GLFW_KEY_M))
+        {
+            useRtin = !useRtin;
+        }
+        bool finer = key_pressed_once(window, GLFW_KEY_LEFT_BRACKET);
+        bool coarser = key_pressed_once(window, GLFW_KEY_RIGHT_BRACKET);
+        if (finer || coarser)
+        {
+            rtinMaxError = std::min(std::max(rtinMaxError * (coarser ? 2.0f : 0.5f), RTIN_MIN_MAX_ERROR),
+                                    RTIN_MAX_MAX_ERROR);
+            rtinIndexCount = upload_rtin_mesh(rtin, rtinMaxError, vao_rtin_mesh,
+                                              vbo_rtin_mesh_vertices, vbo_rtin_mesh_indices);
+            renderQueue.invalidate();
+        }
+
+        //update the fps in the window, draw stats are from the last frame
+        char stats[128];
+        const RenderQueueStats& queueStats = renderQueue.stats();
+        if (useRtin)
+        {
+            snprintf(stats, sizeof(stats), "rtin error %.3f, %d triangles, %d packets, %d draws, %d state changes",
+                     rtinMaxError, rtinIndexCount / 3, queueStats.packets, queueStats.draws, queueStats.stateChanges);
+        }
+        else
+        {
+            snprintf(stats, sizeof(stats), "grid, %d triangles, %d packets, %d draws, %d state changes",
+                     MESH_TRIANGLES_COUNT, queueStats.packets, queueStats.draws, queueStats.stateChanges);
+        }
+        update_fps(window, stats);
         //update camera (consider redoing camera header file... should make cpp)
         camera.update_camera_from_inputs(window);
+        //keep the camera above the terrain, the rtin surface can be up to
+        //its error threshold away from the sampled height
+        glm::vec3& eye = camera.position();
+        float clearance = CAMERA_GROUND_CLEARANCE + (useRtin ? rtinMaxError : 0.0f);
+        eye.y = std::max(eye.y, heightfield.height_at(eye.x, eye.z) + clearance);
         glm::mat4 projection4 = camera.getPerspectiveMatrix();
         glm::mat4 view4 = camera.getViewMatrix();
         glm::mat4 model4 = glm::mat4(1.0f);
@@ -616,32 +755,71 @@ int main()
 
         //Draw Everything
         //Draw mesh
-        glUniform1f(currentObject, 0);
-        glBindVertexArray(vao_terrain_mesh);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDrawElements(GL_TRIANGLE_STRIP, MESH_INDICES_COUNT, GL_UNSIGNED_INT, 0);
+        DrawPacket terrainPacket;
+        terrainPacket.program = program;
+        terrainPacket.objectUniform = currentObject;
+        terrainPacket.objectValue = 0;
+        if (useRtin)
+        {
+            terrainPacket.vao = vao_rtin_mesh;
+            terrainPacket.mode = GL_TRIANGLES;
+            terrainPacket.count = rtinIndexCount;
+        }
+        else
+        {
+            terrainPacket.vao = vao_terrain_mesh;
+            terrainPacket.mode = GL_TRIANGLE_STRIP;
+            terrainPacket.count = MESH_INDICES_COUNT;
+        }
+        renderQueue.submit(terrainPacket);
 
         //Drawskybox (draw last)
-        glDepthFunc(GL_LEQUAL);
-        glUniform1f(currentObject, 1);
-        glBindVertexArray(vao_skybox);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glDepthFunc(GL_LESS);
-
+        DrawPacket skyboxPacket;
+        skyboxPacket.layer = 1;
+        skyboxPacket.program = program;
+        skyboxPacket.objectUniform = currentObject;
+        skyboxPacket.objectValue = 1;
+        skyboxPacket.vao = vao_skybox;
+        skyboxPacket.depthFunc = GL_LEQUAL;
+        skyboxPacket.indexed = false;
+        skyboxPacket.count = 36;
+        renderQueue.submit(skyboxPacket);
+
+        renderQueue.flush();
 
         //end with this
         glfwPollEvents();
         glfwSwapBuffers(window);
 
     }
-    glDeleteTextures(6, textureIDs);
+    renderQueue.release();
+    delete_tracked_textures(7, textureIDs);
     glDeleteProgram(program);
     glDeleteVertexArrays(1, &vao_skybox);
     glDeleteVertexArrays(1, &vao_terrain_mesh);
-    glDeleteBuffers(1, &vbo_skybox);
-    glDeleteBuffers(1, &vbo_terrain_mesh_vertices);
-    glDeleteBuffers(1, &vbo_terrain_mesh_indicies);
+    glDeleteVertexArrays(1, &vao_rtin_mesh);
+    delete_tracked_buffers(1, &vbo_skybox);
+    delete_tracked_buffers(1, &vbo_terrain_mesh_vertices);
+    delete_tracked_buffers(1, &vbo_terrain_mesh_indicies);
+    delete_tracked_buffers(1, &vbo_rtin_mesh_vertices);
+    delete_tracked_buffers(1, &vbo_rtin_mesh_indices);
 
     glfwDestroyWindow(window);
     glfwTerminate();
 }
+
+int main()
+{
+    //live and peak memory per subsystem is printed at exit, P prints it now
+    memory_report_at_exit();
+
+    run_scene();
+
+    //run_scene is out of scope, so anything still live on the host or the
+    //gpu leaked. The exit report shows which subsystem it belongs to.
+    if (memory_tracker().live(MEMORY_HOST) > 0 || memory_tracker().live(MEMORY_GPU) > 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef MEMORY_TRACKER_HPP
+#define MEMORY_TRACKER_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+//subsystem every allocation is charged to
+enum MemoryCategory
+{
+    MEMORY_NOISE,
+    MEMORY_HEIGHTFIELD,
+    MEMORY_TERRAIN_MESH,
+    MEMORY_RTIN,
+    MEMORY_SKYBOX,
+    MEMORY_TEXTURES,
+    MEMORY_RENDER_QUEUE,
+    MEMORY_CATEGORY_COUNT
+};
+
+enum MemoryPool
+{
+    MEMORY_HOST,
+    MEMORY_GPU,
+    MEMORY_POOL_COUNT
+};
+
+enum MemoryGLObject
+{
+    MEMORY_GL_BUFFER,
+    MEMORY_GL_TEXTURE
+};
+
+inline const char* memory_category_name(MemoryCategory category)
+{
+    static const char* names[MEMORY_CATEGORY_COUNT] = {
+        "noise", "heightfield", "terrain mesh", "rtin", "skybox", "textures", "render queue"
+    };
+    return names[category];
+}
+
+struct MemoryUsage
+{
+    size_t live = 0;
+    size_t peak = 0;
+};
+
+//live and peak bytes per category and pool. GL objects are remembered by id
+//so respecifying or deleting one releases the bytes it held before.
+class MemoryTracker
+{
+public:
+    void allocate(MemoryCategory category, MemoryPool pool, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        add(category, pool, bytes);
+    };
+
+    void release(MemoryCategory category, MemoryPool pool, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        remove(category, pool, bytes);
+    };
+
+    void track_gl_object(MemoryGLObject kind, unsigned int id, MemoryCategory category, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        GLObjectKey key(kind, id);
+        std::map<GLObjectKey, GLObjectSize>::iterator it = _gl_objects.find(key);
+        if (it != _gl_objects.end())
+        {
+            remove(it->second.first, MEMORY_GPU, it->second.second);
+        }
+        _gl_objects[key] = GLObjectSize(category, bytes);
+        add(category, MEMORY_GPU, bytes);
+    };
+
+    void untrack_gl_object(MemoryGLObject kind, unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<GLObjectKey, GLObjectSize>::iterator it = _gl_objects.find(GLObjectKey(kind, id));
+        if (it != _gl_objects.end())
+        {
+            remove(it->second.first, MEMORY_GPU, it->second.second);
+            _gl_objects.erase(it);
+        }
+    };
+
+    MemoryUsage usage(MemoryCategory category, MemoryPool pool)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _usage[category][pool];
+    };
+
+    //live bytes in a pool across every category
+    size_t live(MemoryPool pool)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        size_t bytes = 0;
+        for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+        {
+            bytes += _usage[c][pool].live;
+        }
+        return bytes;
+    };
+
+    //prints live and peak bytes per category, returns the total live bytes
+    size_t report(FILE* out)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        size_t total_live = 0;
+        size_t total_peak[MEMORY_POOL_COUNT] = { 0, 0 };
+
+        fprintf(out, "%-14s %12s %12s %12s %12s\n", "memory", "host live", "host peak", "gpu live", "gpu peak");
+        for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+        {
+            const MemoryUsage& host = _usage[c][MEMORY_HOST];
+            const MemoryUsage& gpu = _usage[c][MEMORY_GPU];
+            fprintf(out, "%-14s %12zu %12zu %12zu %12zu\n", memory_category_name((MemoryCategory) c),
+                    host.live, host.peak, gpu.live, gpu.peak);
+            total_live += host.live + gpu.live;
+            total_peak[MEMORY_HOST] += host.peak;
+            total_peak[MEMORY_GPU] += gpu.peak;
+        }
+        fprintf(out, "%-14s %12s %12zu %12s %12zu\n", "sum of peaks", "", total_peak[MEMORY_HOST], "",
+                total_peak[MEMORY_GPU]);
+        return total_live;
+    };
+
+private:
+
+    typedef std::pair<int, unsigned int> GLObjectKey;
+    typedef std::pair<MemoryCategory, size_t> GLObjectSize;
+
+    void add(MemoryCategory category, MemoryPool pool, size_t bytes)
+    {
+        MemoryUsage& usage = _usage[category][pool];
+        usage.live += bytes;
+        usage.peak = std::max(usage.peak, usage.live);
+    };
+
+    void remove(MemoryCategory category, MemoryPool pool, size_t bytes)
+    {
+        MemoryUsage& usage = _usage[category][pool];
+        usage.live -= std::min(usage.live, bytes);
+    };
+
+    std::mutex _mutex;
+    MemoryUsage _usage[MEMORY_CATEGORY_COUNT][MEMORY_POOL_COUNT];
+    std::map<GLObjectKey, GLObjectSize> _gl_objects;
+};
+
+//never destroyed, so allocations freed during static destruction still work
+inline MemoryTracker& memory_tracker()
+{
+    static MemoryTracker* tracker = new MemoryTracker();
+    return *tracker;
+}
+
+//bytes for a texture with its full mip chain down to 1x1
+inline size_t memory_texture_bytes(int width, int height, int bytes_per_texel, bool mipmapped)
+{
+    size_t bytes = 0;
+    while (true)
+    {
+        bytes += (size_t) width * height * bytes_per_texel;
+        if (!mipmapped || (width == 1 && height == 1))
+        {
+            return bytes;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+inline void memory_exit_report()
+{
+    size_t live = memory_tracker().report(stderr);
+    if (live > 0)
+    {
+        fprintf(stderr, "memory leak: %zu bytes still live at exit\n", live);
+    }
+}
+
+//prints the report once the program has exited and everything in main and
+//static storage is released. Only reports, the caller decides the exit status.
+inline void memory_report_at_exit()
+{
+    memory_tracker();
+    atexit(memory_exit_report);
+}
+
+//charges stack arrays (including VLAs) to a category while they are in scope
+class MemoryScope
+{
+public:
+    MemoryScope(MemoryCategory category, size_t bytes)
+    {
+        _category = category;
+        _bytes = bytes;
+        memory_tracker().allocate(_category, MEMORY_HOST, _bytes);
+    };
+
+    ~MemoryScope()
+    {
+        memory_tracker().release(_category, MEMORY_HOST, _bytes);
+    };
+
+private:
+    MemoryScope(const MemoryScope&);
+    MemoryScope& operator=(const MemoryScope&);
+
+    MemoryCategory _category;
+    size_t _bytes;
+};
+
+//std allocator that charges a category, e.g.
+//std::vector<float, TrackedAllocator<float, MEMORY_NOISE> >
+template <class T, MemoryCategory Category>
+struct TrackedAllocator
+{
+    typedef T value_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef TrackedAllocator<U, Category> other;
+    };
+
+    TrackedAllocator() {}
+
+    template <class U>
+    TrackedAllocator(const TrackedAllocator<U, Category>&) {}
+
+    T* allocate(size_t n)
+    {
+        T* p = std::allocator<T>().allocate(n);
+        memory_tracker().allocate(Category, MEMORY_HOST, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        memory_tracker().release(Category, MEMORY_HOST, n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template <class T, class U, MemoryCategory Category>
+bool operator==(const TrackedAllocator<T, Category>&, const TrackedAllocator<U, Category>&)
+{
+    return true;
+}
+
+template <class T, class U, MemoryCategory Category>
+bool operator!=(const TrackedAllocator<T, Category>&, const TrackedAllocator<U, Category>&)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,295 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef NOISE_HPP
+#define NOISE_HPP
+
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <utility>
+#include "terrain.hpp"
+#include "memory_tracker.hpp"
+
+//largest octave count with a compile time kernel
+#define NOISE_MAX_SPECIALIZED_OCTAVES 8
+
+//==============================================================================
+// PERLIN NOISE
+//==============================================================================
+
+inline float rand_func()
+{
+    return ((float) std::rand())/((float) RAND_MAX);
+}
+
+inline float interpolate(float x, float y, float alpha)
+{
+    return (x * (1.0f - alpha)) + (alpha * y);
+}
+
+//quintic
+constexpr float blend(float t)
+{
+    float t3 = t * t * t;
+    return 6 * t * t * t3 - 15 * t * t3 + 10 * t3;
+}
+
+constexpr float blend_cubic(float t)
+{
+    return t * t * (3 - 2 * t);
+}
+
+constexpr float blend_linear(float t)
+{
+    return t;
+}
+
+inline void generate_base_noise(float (&baseNoise)[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE], int width, int height)
+{
+    //random seed
+    std::srand(0);
+    for (int i = 0; i < width; i++)
+    {
+        for (int j = 0; j < height; j++)
+        {
+            baseNoise[i][j] = rand_func();
+        }
+    }
+}
+
+inline void generate_smooth_noise(float (&baseNoise)[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE], int width, int height, int octave,
+                                  float (&smoothNoise)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE],
+                                  float (*blend_func)(float) = blend)
+{
+    int period = pow(2, octave);
+    float frequency = 1.0f / period;
+    int n = 0;
+    for (int i = 0; i < width; i++)
+    {
+        int leftSample = (i / period) * period;
+        int rightSample = (leftSample + period) % width;
+        float dx_blend = (i - leftSample) * frequency;
+
+        for (int j = 0; j < height; j++)
+        {
+            int topSample = (j / period) * period;
+            int bottomSample = (topSample + period) % height;
+            float dy_blend = (j - topSample) * frequency;
+
+
+            float fx = blend_func(dx_blend);
+            float fy = blend_func(dy_blend);
+
+            float top = interpolate(baseNoise[leftSample][topSample],
+                                    baseNoise[rightSample][topSample],
+                                    fx);
+
+            float bottom = interpolate(baseNoise[leftSample][bottomSample],
+                                    baseNoise[rightSample][bottomSample],
+                                    fx);
+
+
+            smoothNoise[n++] = interpolate(top, bottom, fy);
+        }
+    }
+}
+
+inline void generate_perlin_noise(float (&perlinNoise)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE], int width, int height, int octaveCount,
+                                  float persistance = 0.5f, float (*blend_func)(float) = blend)
+{
+    float baseNoise[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE];
+    generate_base_noise(baseNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE);
+
+    float smoothNoise[octaveCount][MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE];
+    MemoryScope stackMemory(MEMORY_NOISE, sizeof(baseNoise) + sizeof(smoothNoise));
+
+    float amplitude = 1.0f;
+    float totalAmplitude = 0.0f;
+
+    for (int i = 0; i < octaveCount; i++)
+    {
+        generate_smooth_noise(baseNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, i, smoothNoise[i], blend_func);
+    }
+
+    for (int octave = octaveCount - 1; octave >= 0; octave--)
+    {
+        amplitude *= persistance;
+        totalAmplitude += amplitude;
+
+        for (int i = 0; i < width * height; i++)
+        {
+            perlinNoise[i] += smoothNoise[octave][i] * amplitude;
+        }
+    }
+
+    for (int i = 0; i < width * height; i++)
+    {
+        perlinNoise[i] /= totalAmplitude;
+
+    }
+}
+
+//==============================================================================
+// SPECIALIZED PERLIN NOISE
+//==============================================================================
+
+//blend weight for every offset inside one period, built at compile time
+template <int Period, float (*Blend)(float)>
+struct BlendTable
+{
+    float weights[Period];
+
+    constexpr BlendTable() : weights()
+    {
+        for (int k = 0; k < Period; k++)
+        {
+            weights[k] = Blend(k * (1.0f / Period));
+        }
+    }
+};
+
+//adds one octave of smooth noise, scaled by amplitude, into perlinNoise.
+//same math as generate_smooth_noise with the divides turned into masks.
+template <int Width, int Height, int Octave, float (*Blend)(float)>
+void accumulate_smooth_noise(const float (&baseNoise)[Width][Height], float amplitude,
+                             float (&perlinNoise)[Width * Height])
+{
+    constexpr int period = 1 << Octave;
+    constexpr int offsetMask = period - 1;
+    static constexpr BlendTable<period, Blend> table{};
+
+    int n = 0;
+    for (int i = 0; i < Width; i++)
+    {
+        int leftSample = i & ~offsetMask;
+        int rightSample = (leftSample + period) & (Width - 1);
+        float fx = table.weights[i & offsetMask];
+
+        for (int j = 0; j < Height; j++)
+        {
+            int topSample = j & ~offsetMask;
+            int bottomSample = (topSample + period) & (Height - 1);
+            float fy = table.weights[j & offsetMask];
+
+            float top = interpolate(baseNoise[leftSample][topSample],
+                                    baseNoise[rightSample][topSample],
+                                    fx);
+
+            float bottom = interpolate(baseNoise[leftSample][bottomSample],
+                                    baseNoise[rightSample][bottomSample],
+                                    fx);
+
+            perlinNoise[n++] += interpolate(top, bottom, fy) * amplitude;
+        }
+    }
+}
+
+//unrolls the octave loop, highest octave first like generate_perlin_noise
+template <int Width, int Height, int Octave, float (*Blend)(float)>
+struct PerlinOctaves
+{
+    static void accumulate(const float (&baseNoise)[Width][Height], float persistance,
+                           float& amplitude, float& totalAmplitude,
+                           float (&perlinNoise)[Width * Height])
+    {
+        amplitude *= persistance;
+        totalAmplitude += amplitude;
+        accumulate_smooth_noise<Width, Height, Octave, Blend>(baseNoise, amplitude, perlinNoise);
+        PerlinOctaves<Width, Height, Octave - 1, Blend>::accumulate(baseNoise, persistance, amplitude,
+                                                                    totalAmplitude, perlinNoise);
+    }
+};
+
+template <int Width, int Height, float (*Blend)(float)>
+struct PerlinOctaves<Width, Height, -1, Blend>
+{
+    static void accumulate(const float (&)[Width][Height], float, float&, float&, float (&)[Width * Height])
+    {
+    }
+};
+
+template <int Width, int Height, int OctaveCount, float (*Blend)(float)>
+void perlin_noise_kernel(const float (&baseNoise)[Width][Height], float persistance,
+                         float (&perlinNoise)[Width * Height])
+{
+    static_assert((Width & (Width - 1)) == 0 && (Height & (Height - 1)) == 0,
+                  "noise dimensions must be powers of two");
+
+    float amplitude = 1.0f;
+    float totalAmplitude = 0.0f;
+
+    std::fill(std::begin(perlinNoise), std::end(perlinNoise), 0.0f);
+    PerlinOctaves<Width, Height, OctaveCount - 1, Blend>::accumulate(baseNoise, persistance, amplitude,
+                                                                     totalAmplitude, perlinNoise);
+
+    for (int i = 0; i < Width * Height; i++)
+    {
+        perlinNoise[i] /= totalAmplitude;
+    }
+}
+
+typedef void (*PerlinNoiseKernel)(const float (&)[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE], float,
+                                  float (&)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE]);
+
+//one kernel per octave count, entry i runs i + 1 octaves
+template <float (*Blend)(float), int... Octaves>
+const PerlinNoiseKernel* perlin_noise_kernels(std::integer_sequence<int, Octaves...>)
+{
+    static const PerlinNoiseKernel kernels[] = {
+        perlin_noise_kernel<MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE, Octaves + 1, Blend>...
+    };
+    return kernels;
+}
+
+//NULL when octaveCount has no kernel
+template <float (*Blend)(float)>
+PerlinNoiseKernel select_perlin_noise_kernel(int octaveCount)
+{
+    static_assert(NOISE_MAX_SPECIALIZED_OCTAVES >= 1, "need at least one specialized octave count");
+    if (octaveCount < 1 || octaveCount > NOISE_MAX_SPECIALIZED_OCTAVES)
+    {
+        return NULL;
+    }
+    return perlin_noise_kernels<Blend>(std::make_integer_sequence<int, NOISE_MAX_SPECIALIZED_OCTAVES>())[octaveCount - 1];
+}
+
+//maps a runtime noise config onto a compile time kernel. Configs without a
+//kernel (other sizes, octave counts or blend functions) use the generic path.
+//Unlike generate_perlin_noise, perlinNoise does not need to be zeroed first.
+inline void generate_perlin_noise_specialized(float (&perlinNoise)[MESH_X_VERTICES_SIZE * MESH_Z_VERTICES_SIZE],
+                                              int width, int height, int octaveCount,
+                                              float persistance = 0.5f, float (*blend_func)(float) = blend)
+{
+    PerlinNoiseKernel kernel = NULL;
+    if (width == MESH_X_VERTICES_SIZE && height == MESH_Z_VERTICES_SIZE)
+    {
+        if (blend_func == blend)
+        {
+            kernel = select_perlin_noise_kernel<blend>(octaveCount);
+        }
+        else if (blend_func == blend_cubic)
+        {
+            kernel = select_perlin_noise_kernel<blend_cubic>(octaveCount);
+        }
+        else if (blend_func == blend_linear)
+        {
+            kernel = select_perlin_noise_kernel<blend_linear>(octaveCount);
+        }
+    }
+
+    if (kernel == NULL)
+    {
+        std::fill(std::begin(perlinNoise), std::end(perlinNoise), 0.0f);
+        generate_perlin_noise(perlinNoise, width, height, octaveCount, persistance, blend_func);
+        return;
+    }
+
+    float baseNoise[MESH_X_VERTICES_SIZE][MESH_Z_VERTICES_SIZE];
+    MemoryScope stackMemory(MEMORY_NOISE, sizeof(baseNoise));
+    generate_base_noise(baseNoise, MESH_X_VERTICES_SIZE, MESH_Z_VERTICES_SIZE);
+    kernel(baseNoise, persistance, perlinNoise);
+}
+
+#endif
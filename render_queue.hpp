@@ -0,0 +1,318 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "memory_tracker.hpp"
+
+//one draw and the state it needs. Indexed draws always use GL_UNSIGNED_INT
+//indices from the element buffer bound to the vao.
+struct DrawPacket
+{
+    //packets are drawn in layer order first, e.g. the skybox after terrain
+    int layer = 0;
+
+    GLuint program = 0;
+    //texture 0 leaves the texture units alone
+    GLenum textureUnit = GL_TEXTURE0;
+    GLenum textureTarget = GL_TEXTURE_2D;
+    GLuint texture = 0;
+    GLuint vao = 0;
+    GLenum polygonMode = GL_FILL;
+    GLenum depthFunc = GL_LESS;
+    //float uniform set per packet, -1 for none
+    GLint objectUniform = -1;
+    GLfloat objectValue = 0.0f;
+
+    GLenum mode = GL_TRIANGLES;
+    bool indexed = true;
+    GLsizei count = 0;
+    //first index for indexed draws, first vertex otherwise
+    GLuint first = 0;
+    GLint baseVertex = 0;
+};
+
+struct RenderQueueStats
+{
+    int packets = 0;
+    int draws = 0;
+    int stateChanges = 0;
+};
+
+//Collects draw packets for a frame, sorts them by state and only issues the
+//state changes that differ from what is already bound. Runs of indexed
+//packets sharing all state become one multi draw call, indirect when the
+//context has GL 4.3 / ARB_multi_draw_indirect.
+class RenderQueue
+{
+public:
+    typedef std::vector<DrawPacket, TrackedAllocator<DrawPacket, MEMORY_RENDER_QUEUE> > PacketBuffer;
+
+    //needs a current GL context
+    RenderQueue()
+    {
+        _use_indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+        _indirect_buffer = 0;
+        if (_use_indirect)
+        {
+            glGenBuffers(1, &_indirect_buffer);
+        }
+        invalidate();
+    };
+
+    void release()
+    {
+        if (_indirect_buffer != 0)
+        {
+            memory_tracker().untrack_gl_object(MEMORY_GL_BUFFER, _indirect_buffer);
+            glDeleteBuffers(1, &_indirect_buffer);
+            _indirect_buffer = 0;
+            _uploaded_commands.clear();
+        }
+    };
+
+    //forget the cached state, call after binding things outside the queue
+    void invalidate()
+    {
+        _state_valid = false;
+    };
+
+    void submit(const DrawPacket& packet)
+    {
+        _packets.push_back(packet);
+    };
+
+    //draws and clears everything submitted since the last flush
+    void flush()
+    {
+        _stats = RenderQueueStats();
+        _stats.packets = _packets.size();
+
+        sort(_packets);
+
+        size_t i = 0;
+        while (i < _packets.size())
+        {
+            const DrawPacket& packet = _packets[i];
+            apply_state(packet);
+
+            size_t end = batch_end(_packets, i);
+
+            if (packet.indexed)
+            {
+                draw_elements(i, end);
+            }
+            else
+            {
+                for (size_t p = i; p < end; p++)
+                {
+                    glDrawArrays(_packets[p].mode, _packets[p].first, _packets[p].count);
+                    _stats.draws++;
+                }
+            }
+            i = end;
+        }
+        _packets.clear();
+    };
+
+    //counts for the last flush
+    const RenderQueueStats& stats() const
+    {
+        return _stats;
+    };
+
+    //the order flush draws packets in. Makes no GL calls.
+    static void sort(PacketBuffer& packets)
+    {
+        std::stable_sort(packets.begin(), packets.end(), packet_less);
+    };
+
+    //one past the last sorted packet that shares a batch with packets[begin].
+    //An indexed batch is a single draw call. Makes no GL calls.
+    static size_t batch_end(const PacketBuffer& packets, size_t begin)
+    {
+        size_t end = begin + 1;
+        while (end < packets.size() && same_batch(packets[begin], packets[end]))
+        {
+            end++;
+        }
+        return end;
+    };
+
+private:
+
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    static bool same_state(const DrawPacket& a, const DrawPacket& b)
+    {
+        return a.program == b.program
+            && a.textureUnit == b.textureUnit
+            && a.textureTarget == b.textureTarget
+            && a.texture == b.texture
+            && a.vao == b.vao
+            && a.polygonMode == b.polygonMode
+            && a.depthFunc == b.depthFunc
+            && a.objectUniform == b.objectUniform
+            && a.objectValue == b.objectValue;
+    };
+
+    static bool same_batch(const DrawPacket& a, const DrawPacket& b)
+    {
+        return a.layer == b.layer && same_state(a, b) && a.mode == b.mode && a.indexed == b.indexed;
+    };
+
+    //most expensive state changes sort first. Covers every field same_batch
+    //compares, so packets that can share a batch always end up next to each other.
+    static bool packet_less(const DrawPacket& a, const DrawPacket& b)
+    {
+        if (a.layer != b.layer) return a.layer < b.layer;
+        if (a.program != b.program) return a.program < b.program;
+        if (a.texture != b.texture) return a.texture < b.texture;
+        if (a.textureTarget != b.textureTarget) return a.textureTarget < b.textureTarget;
+        if (a.textureUnit != b.textureUnit) return a.textureUnit < b.textureUnit;
+        if (a.vao != b.vao) return a.vao < b.vao;
+        if (a.depthFunc != b.depthFunc) return a.depthFunc < b.depthFunc;
+        if (a.polygonMode != b.polygonMode) return a.polygonMode < b.polygonMode;
+        if (a.objectUniform != b.objectUniform) return a.objectUniform < b.objectUniform;
+        if (a.objectValue != b.objectValue) return a.objectValue < b.objectValue;
+        if (a.mode != b.mode) return a.mode < b.mode;
+        return a.indexed < b.indexed;
+    };
+
+    void apply_state(const DrawPacket& packet)
+    {
+        if (!_state_valid || packet.program != _bound.program)
+        {
+            glUseProgram(packet.program);
+            _stats.stateChanges++;
+        }
+        if (packet.texture != 0 && (!_state_valid || packet.texture != _bound.texture
+                                    || packet.textureUnit != _bound.textureUnit
+                                    || packet.textureTarget != _bound.textureTarget))
+        {
+            glActiveTexture(packet.textureUnit);
+            glBindTexture(packet.textureTarget, packet.texture);
+            _stats.stateChanges++;
+        }
+        if (!_state_valid || packet.vao != _bound.vao)
+        {
+            glBindVertexArray(packet.vao);
+            _stats.stateChanges++;
+        }
+        if (!_state_valid || packet.polygonMode != _bound.polygonMode)
+        {
+            glPolygonMode(GL_FRONT_AND_BACK, packet.polygonMode);
+            _stats.stateChanges++;
+        }
+        if (!_state_valid || packet.depthFunc != _bound.depthFunc)
+        {
+            glDepthFunc(packet.depthFunc);
+            _stats.stateChanges++;
+        }
+        if (packet.objectUniform >= 0 && (!_state_valid || packet.program != _bound.program
+                                          || packet.objectUniform != _bound.objectUniform
+                                          || packet.objectValue != _bound.objectValue))
+        {
+            glUniform1f(packet.objectUniform, packet.objectValue);
+            _stats.stateChanges++;
+        }
+
+        //keep the last bound texture when the packet does not bind one
+        GLuint texture = _bound.texture;
+        GLenum textureUnit = _bound.textureUnit;
+        GLenum textureTarget = _bound.textureTarget;
+        _bound = packet;
+        if (packet.texture == 0)
+        {
+            _bound.texture = texture;
+            _bound.textureUnit = textureUnit;
+            _bound.textureTarget = textureTarget;
+        }
+        _state_valid = true;
+    };
+
+    void draw_elements(size_t begin, size_t end)
+    {
+        const DrawPacket& packet = _packets[begin];
+        GLsizei drawCount = end - begin;
+
+        if (drawCount == 1)
+        {
+            glDrawElementsBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT,
+                                     (void*)(packet.first * sizeof(GLuint)), packet.baseVertex);
+        }
+        else if (_use_indirect)
+        {
+            _commands.clear();
+            for (size_t p = begin; p < end; p++)
+            {
+                DrawElementsIndirectCommand command = { (GLuint) _packets[p].count, 1, _packets[p].first,
+                                                        _packets[p].baseVertex, 0 };
+                _commands.push_back(command);
+            }
+            size_t bytes = _commands.size() * sizeof(DrawElementsIndirectCommand);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirect_buffer);
+            //the same chunks usually come back every frame, keep their commands
+            if (_commands.size() != _uploaded_commands.size()
+                || memcmp(_commands.data(), _uploaded_commands.data(), bytes) != 0)
+            {
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, _commands.data(), GL_STREAM_DRAW);
+                memory_tracker().track_gl_object(MEMORY_GL_BUFFER, _indirect_buffer, MEMORY_RENDER_QUEUE, bytes);
+                _uploaded_commands = _commands;
+            }
+            glMultiDrawElementsIndirect(packet.mode, GL_UNSIGNED_INT, 0, drawCount, 0);
+        }
+        else
+        {
+            _counts.clear();
+            _offsets.clear();
+            _base_vertices.clear();
+            for (size_t p = begin; p < end; p++)
+            {
+                _counts.push_back(_packets[p].count);
+                _offsets.push_back((void*)(uintptr_t)(_packets[p].first * sizeof(GLuint)));
+                _base_vertices.push_back(_packets[p].baseVertex);
+            }
+            glMultiDrawElementsBaseVertex(packet.mode, _counts.data(), GL_UNSIGNED_INT,
+                                          _offsets.data(), drawCount, _base_vertices.data());
+        }
+        _stats.draws++;
+    };
+
+    template <class T>
+    struct Buffer
+    {
+        typedef std::vector<T, TrackedAllocator<T, MEMORY_RENDER_QUEUE> > type;
+    };
+
+    PacketBuffer _packets;
+    DrawPacket _bound;
+    bool _state_valid;
+
+    bool _use_indirect;
+    GLuint _indirect_buffer;
+    Buffer<DrawElementsIndirectCommand>::type _commands;
+    //what the indirect buffer holds
+    Buffer<DrawElementsIndirectCommand>::type _uploaded_commands;
+    Buffer<GLsizei>::type _counts;
+    Buffer<void*>::type _offsets;
+    Buffer<GLint>::type _base_vertices;
+
+    RenderQueueStats _stats;
+};
+
+#endif
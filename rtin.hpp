@@ -0,0 +1,250 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef RTIN_HPP
+#define RTIN_HPP
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "memory_tracker.hpp"
+
+//levels with fewer triangles than this are not worth a thread
+#define RTIN_MIN_TRIANGLES_PER_THREAD 1024
+
+//Right triangulated irregular network over a square heightmap of
+//(2^k + 1) * (2^k + 1) samples. update() precomputes the error of every
+//triangle split once, after which mesh() can extract a triangulation for
+//any error threshold. Flat regions collapse into a few large triangles.
+class Rtin
+{
+public:
+    typedef std::vector<unsigned int, TrackedAllocator<unsigned int, MEMORY_RTIN> > Buffer;
+
+    Rtin(int grid_size)
+        : _errors(grid_size * grid_size)
+    {
+        //the triangle tree only lines up with (2^k + 1) sample grids
+        assert(grid_size >= 3 && ((grid_size - 1) & (grid_size - 2)) == 0);
+
+        _grid_size = grid_size;
+        int tile_size = grid_size - 1;
+
+        _num_triangles = tile_size * tile_size * 2 - 2;
+        _num_parent_triangles = _num_triangles - tile_size * tile_size;
+        _coords.resize(_num_triangles * 4);
+        _vertex_ids.resize(grid_size * grid_size);
+
+        //triangle i is node i + 2 of an implicit binary tree, walk down from
+        //the root to find its corners
+        for (int i = 0; i < _num_triangles; i++)
+        {
+            int id = i + 2;
+            int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+            if (id & 1)
+            {
+                //bottom-left triangle
+                bx = by = cx = tile_size;
+            }
+            else
+            {
+                //top-right triangle
+                ax = ay = cy = tile_size;
+            }
+            while ((id >>= 1) > 1)
+            {
+                int mx = (ax + bx) >> 1;
+                int my = (ay + by) >> 1;
+
+                if (id & 1)
+                {
+                    //left half
+                    bx = ax;
+                    by = ay;
+                    ax = cx;
+                    ay = cy;
+                }
+                else
+                {
+                    //right half
+                    ax = bx;
+                    ay = by;
+                    bx = cx;
+                    by = cy;
+                }
+                cx = mx;
+                cy = my;
+            }
+            _coords[i * 4 + 0] = ax;
+            _coords[i * 4 + 1] = ay;
+            _coords[i * 4 + 2] = bx;
+            _coords[i * 4 + 3] = by;
+        }
+    };
+
+    int grid_size() const
+    {
+        return _grid_size;
+    };
+
+    //heights is grid_size * grid_size samples, row y column x. Triangles of
+    //one tree level are independent, so each level is split across threads
+    //once the level below it has finished.
+    void update(const float* heights)
+    {
+        for (int i = 0; i < _grid_size * _grid_size; i++)
+        {
+            _errors[i].store(0, std::memory_order_relaxed);
+        }
+
+        int thread_count = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> threads;
+
+        //depth d holds tree nodes [2^d, 2^(d+1)), deepest level first
+        int depth = 0;
+        while ((2 << depth) - 2 < _num_triangles)
+        {
+            depth++;
+        }
+        for (; depth >= 1; depth--)
+        {
+            int begin = (1 << depth) - 2;
+            int end = std::min((2 << depth) - 2, _num_triangles);
+            int count = end - begin;
+
+            int level_threads = std::min(thread_count, std::max(1, count / RTIN_MIN_TRIANGLES_PER_THREAD));
+            if (level_threads == 1)
+            {
+                update_triangles(heights, begin, end);
+                continue;
+            }
+
+            for (int t = 0; t < level_threads; t++)
+            {
+                int first = begin + (int)((long)count * t / level_threads);
+                int last = begin + (int)((long)count * (t + 1) / level_threads);
+                threads.push_back(std::thread(&Rtin::update_triangles, this, heights, first, last));
+            }
+            for (size_t t = 0; t < threads.size(); t++)
+            {
+                threads[t].join();
+            }
+            threads.clear();
+        }
+    };
+
+    //triangulation where no dropped vertex is more than max_error away from
+    //the surface. vertices gets (x, y) grid coordinate pairs and triangles
+    //three indices into them per triangle. Returns the triangle count.
+    int mesh(float max_error, Buffer& vertices, Buffer& triangles)
+    {
+        int max = _grid_size - 1;
+
+        std::fill(_vertex_ids.begin(), _vertex_ids.end(), -1);
+        vertices.clear();
+        triangles.clear();
+
+        process_triangle(max_error, 0, 0, max, max, max, 0, vertices, triangles);
+        process_triangle(max_error, max, max, 0, 0, 0, max, vertices, triangles);
+
+        return triangles.size() / 3;
+    };
+
+private:
+
+    static float error_at(const std::atomic<uint32_t>& error)
+    {
+        uint32_t bits = error.load(std::memory_order_relaxed);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    };
+
+    //errors are never negative, so their bit patterns sort like the floats
+    static void max_error(std::atomic<uint32_t>& error, float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t current = error.load(std::memory_order_relaxed);
+        while (current < bits && !error.compare_exchange_weak(current, bits, std::memory_order_relaxed))
+        {
+        }
+    };
+
+    void update_triangles(const float* heights, int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            int ax = _coords[i * 4 + 0];
+            int ay = _coords[i * 4 + 1];
+            int bx = _coords[i * 4 + 2];
+            int by = _coords[i * 4 + 3];
+
+            //hypotenuse midpoint and right angle corner
+            int mx = (ax + bx) >> 1;
+            int my = (ay + by) >> 1;
+            int cx = mx + my - ay;
+            int cy = my + ax - mx;
+
+            float interpolated = (heights[ay * _grid_size + ax] + heights[by * _grid_size + bx]) / 2;
+            int middle = my * _grid_size + mx;
+            float error = std::fabs(interpolated - heights[middle]);
+
+            if (i < _num_parent_triangles)
+            {
+                //bigger triangles also carry the error of their children
+                int left_child = ((ay + cy) >> 1) * _grid_size + ((ax + cx) >> 1);
+                int right_child = ((by + cy) >> 1) * _grid_size + ((bx + cx) >> 1);
+                error = std::max(error, std::max(error_at(_errors[left_child]), error_at(_errors[right_child])));
+            }
+            max_error(_errors[middle], error);
+        }
+    };
+
+    unsigned int vertex_id(int x, int y, Buffer& vertices)
+    {
+        int& id = _vertex_ids[y * _grid_size + x];
+        if (id < 0)
+        {
+            id = vertices.size() / 2;
+            vertices.push_back(x);
+            vertices.push_back(y);
+        }
+        return id;
+    };
+
+    void process_triangle(float max_error, int ax, int ay, int bx, int by, int cx, int cy,
+                          Buffer& vertices, Buffer& triangles)
+    {
+        int mx = (ax + bx) >> 1;
+        int my = (ay + by) >> 1;
+
+        if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && error_at(_errors[my * _grid_size + mx]) > max_error)
+        {
+            //too much error, split in two
+            process_triangle(max_error, cx, cy, ax, ay, mx, my, vertices, triangles);
+            process_triangle(max_error, bx, by, cx, cy, mx, my, vertices, triangles);
+        }
+        else
+        {
+            triangles.push_back(vertex_id(ax, ay, vertices));
+            triangles.push_back(vertex_id(bx, by, vertices));
+            triangles.push_back(vertex_id(cx, cy, vertices));
+        }
+    };
+
+    int _grid_size;
+    int _num_triangles;
+    int _num_parent_triangles;
+    std::vector<uint16_t, TrackedAllocator<uint16_t, MEMORY_RTIN> > _coords;
+    std::vector<std::atomic<uint32_t>, TrackedAllocator<std::atomic<uint32_t>, MEMORY_RTIN> > _errors;
+    std::vector<int, TrackedAllocator<int, MEMORY_RTIN> > _vertex_ids;
+};
+
+#endif
@@ -0,0 +1,18 @@
+/* Author: Brett A. Blashko
+ * ID: V00759982
+*/
+
+#ifndef TERRAIN_HPP
+#define TERRAIN_HPP
+
+#define MESH_X_VERTICES_SIZE 128
+#define MESH_Z_VERTICES_SIZE 128
+
+//triangles in the strip grid, the baseline for adaptive meshes
+#define MESH_TRIANGLES_COUNT ((MESH_X_VERTICES_SIZE - 1) * (MESH_Z_VERTICES_SIZE - 1) * 2)
+
+//heights at or below the water level are drawn flat (see scene.vert)
+#define TERRAIN_WATER_LEVEL 0.27f
+#define TERRAIN_HEIGHT_SCALE 20.0f
+
+#endif